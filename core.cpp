@@ -0,0 +1,114 @@
+#include "core.h"
+#include <cstring>
+
+static void DrawSprite(Machine& m, uint8_t Vx, uint8_t Vy, uint8_t height)
+{
+	uint8_t xStart = m.registers[Vx] & (VIDEO_WIDTH - 1);
+	uint8_t yStart = m.registers[Vy] & (VIDEO_HEIGHT - 1);
+	m.registers[0xF] = 0;
+
+	for (uint8_t row = 0; row < height; ++row)
+	{
+		uint8_t y = (yStart + row) & (VIDEO_HEIGHT - 1);
+		uint8_t spriteByte = m.memory[(m.index_reg + row) & (MEMORY_SIZE - 1)];
+		if (spriteByte == 0) continue;
+
+		uint32_t* line = &m.video[y * VIDEO_WIDTH];
+		for (uint8_t col = 0; col < 8; ++col)
+		{
+			if ((spriteByte & (0x80u >> col)) != 0)
+			{
+				uint32_t* screenPixel = &line[(xStart + col) & (VIDEO_WIDTH - 1)];
+				if (*screenPixel == 0xFFFFFFFF) m.registers[0xF] = 1;
+				*screenPixel ^= 0xFFFFFFFF;
+			}
+		}
+	}
+}
+
+void Step(Machine& m)
+{
+	uint16_t opcode = (m.memory[m.pc & (MEMORY_SIZE - 1)] << 8u) | m.memory[(m.pc + 1) & (MEMORY_SIZE - 1)];
+	m.opcode = opcode;
+	m.pc += 2;
+
+	uint8_t x = (opcode & 0x0F00u) >> 8u;
+	uint8_t y = (opcode & 0x00F0u) >> 4u;
+	uint8_t n =  opcode & 0x000Fu;
+	uint8_t kk = opcode & 0x00FFu;
+	uint16_t nnn = opcode & 0x0FFFu;
+	uint8_t* V = m.registers;
+
+	switch (opcode & 0xF000u) {
+		// Like Table0, only kk is decoded (0nE0 and 0nEE act as CLS and RET)
+		case 0x0000u:
+			if (kk == 0xE0u) memset(m.video, 0, sizeof(m.video));
+			else if (kk == 0xEEu) m.pc = m.stack[--m.sp & (STACK_LEVELS - 1)];
+			break;
+		case 0x1000u: m.pc = nnn; break;
+		case 0x2000u: m.stack[m.sp++ & (STACK_LEVELS - 1)] = m.pc; m.pc = nnn; break;
+		case 0x3000u: if (V[x] == kk) m.pc += 2; break;
+		case 0x4000u: if (V[x] != kk) m.pc += 2; break;
+		case 0x5000u: if (V[x] == V[y]) m.pc += 2; break;
+		case 0x6000u: V[x] = kk; break;
+		case 0x7000u: V[x] += kk; break;
+		case 0x8000u:
+			switch (n) {
+				case 0x0u: V[x] = V[y]; break;
+				case 0x1u: V[x] |= V[y]; break;
+				case 0x2u: V[x] &= V[y]; break;
+				case 0x3u: V[x] ^= V[y]; break;
+				// Result is written before VF, same order as rippleCarry
+				case 0x4u: {
+					unsigned sum = V[x] + V[y];
+					V[x] = sum;
+					V[0xF] = sum >> 8u;
+					break;
+				}
+				case 0x5u: {
+					unsigned diff = V[x] + (uint8_t)~V[y] + 1u;
+					V[x] = diff;
+					V[0xF] = diff >> 8u;
+					break;
+				}
+				// VF is written before the shift
+				case 0x6u: V[0xF] = V[x] & 0x1u; V[x] >>= 1; break;
+				case 0xEu: V[0xF] = V[x] >> 7u; V[x] <<= 1; break;
+			}
+			break;
+		case 0x9000u: if (V[x] != V[y]) m.pc += 2; break;
+		case 0xA000u: m.index_reg = nnn; break;
+		case 0xB000u: m.pc = (nnn + V[0]) & 0xFFF; break;
+		case 0xC000u: V[x] = m.randByte(m.randGen) & kk; break;
+		case 0xD000u: DrawSprite(m, x, y, n); break;
+		case 0xE000u:
+			if (kk == 0x9Eu && m.keypad[V[x] & (KEY_COUNT - 1)]) m.pc += 2;
+			else if (kk == 0xA1u && !m.keypad[V[x] & (KEY_COUNT - 1)]) m.pc += 2;
+			break;
+		case 0xF000u:
+			switch (kk) {
+				case 0x07u: V[x] = m.delayTimer; break;
+				case 0x0Au: {
+					uint8_t i = 0;
+					while (i < KEY_COUNT && !m.keypad[i]) ++i;
+					if (i < KEY_COUNT) V[x] = i;
+					else m.pc -= 2;
+					break;
+				}
+				case 0x15u: m.delayTimer = V[x]; break;
+				case 0x18u: m.soundTimer = V[x]; break;
+				case 0x1Eu: m.index_reg += V[x]; break;
+				case 0x29u: m.index_reg = FONTSET_START_ADDRESS + (5 * V[x]); break;
+				case 0x33u: {
+					uint8_t value = V[x];
+					m.memory[(m.index_reg + 2) & (MEMORY_SIZE - 1)] = value % 10;
+					m.memory[(m.index_reg + 1) & (MEMORY_SIZE - 1)] = (value / 10) % 10;
+					m.memory[m.index_reg & (MEMORY_SIZE - 1)] = value / 100;
+					break;
+				}
+				case 0x55u: for (uint8_t i = 0; i <= x; ++i) m.memory[(m.index_reg + i) & (MEMORY_SIZE - 1)] = V[i]; break;
+				case 0x65u: for (uint8_t i = 0; i <= x; ++i) V[i] = m.memory[(m.index_reg + i) & (MEMORY_SIZE - 1)]; break;
+			}
+			break;
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+
+// -- Constants --
+const unsigned int FONTSET_SIZE = 80;
+const unsigned int FONTSET_START_ADDRESS = 0x50;
+const unsigned int START_ADDRESS = 0x200;
+const unsigned int KEY_COUNT = 16;
+const unsigned int MEMORY_SIZE = 4096;
+const unsigned int REGISTER_COUNT = 16;
+const unsigned int STACK_LEVELS = 16;
+const unsigned int VIDEO_HEIGHT = 32;
+const unsigned int VIDEO_WIDTH = 64;
+const unsigned int CYCLES_PER_TIMER_TICK = 8;  // Same ratio as the 2ms cycle / 16.66ms timer loop
+
+// -- Machine Core --
+/*
+ * Self-contained CHIP-8 machine, an alternative execution path to the global
+ * Cycle() in main.cpp. Same instruction semantics, but plain arithmetic instead
+ * of rippleCarry and every state lives in the struct, so several machines can run at once.
+ * Addresses are wrapped to 12 bits and sp to 4 bits so it never runs out of bounds.
+ */
+struct Machine {
+    uint8_t keypad[KEY_COUNT]{};
+    uint32_t video[VIDEO_HEIGHT * VIDEO_WIDTH]{};
+
+    uint8_t memory[MEMORY_SIZE]{};
+    uint8_t registers[REGISTER_COUNT]{};
+    uint16_t index_reg{};
+    uint16_t pc{};
+    uint8_t delayTimer{};
+    uint8_t soundTimer{};
+    uint16_t stack[STACK_LEVELS]{};
+    uint8_t sp{};
+    uint16_t opcode{};
+
+    std::minstd_rand0 randGen;   // Same engine as Cycle(), spelled out so every standard library picks the same one
+    std::uniform_int_distribution<uint8_t> randByte{0, 255};
+};
+
+void Step(Machine& m);
@@ -0,0 +1,487 @@
+#include "explorer.h"
+#include "hash.h"
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// -- Branch State --
+struct Page {
+    uint8_t data[SNAPSHOT_PAGE_SIZE];
+    uint64_t hash;
+};
+using PagePtr = std::shared_ptr<const Page>;
+
+const unsigned int PAGE_COUNT = MEMORY_PAGES + VIDEO_PAGES;
+
+// Machine at a keypad read, pages are shared with the parent when unchanged
+struct Snapshot {
+    PagePtr pages[PAGE_COUNT];
+    uint8_t registers[REGISTER_COUNT]{};
+    uint16_t stack[STACK_LEVELS]{};
+    uint16_t index_reg{};
+    uint16_t pc{};
+    uint8_t delayTimer{};
+    uint8_t soundTimer{};
+    uint8_t sp{};
+    uint8_t timerPhase{};
+    std::minstd_rand0 randGen;
+};
+
+// One keypad decision, linked back to the decisions that led to it
+struct InputNode {
+    std::shared_ptr<const InputNode> parent;
+    uint16_t pc;
+    uint8_t key;
+    bool pressed;
+    unsigned int depth;
+};
+
+struct Task {
+    std::shared_ptr<const Snapshot> state;
+    std::shared_ptr<const InputNode> input;
+};
+
+static uint8_t* PageData(Machine& m, unsigned int page)
+{
+    if (page < MEMORY_PAGES) return m.memory + page * SNAPSHOT_PAGE_SIZE;
+    return reinterpret_cast<uint8_t*>(m.video) + (page - MEMORY_PAGES) * SNAPSHOT_PAGE_SIZE;
+}
+
+// Bit i set for each page the next instruction can write, the same cases as PredictWrites() in lockstep.cpp
+static uint64_t WrittenPages(Machine const& m)
+{
+    uint16_t pc = m.pc & (MEMORY_SIZE - 1);
+    uint16_t opcode = (m.memory[pc] << 8u) | m.memory[(pc + 1) & (MEMORY_SIZE - 1)];
+    uint8_t x = (opcode & 0x0F00u) >> 8u;
+    uint8_t y = (opcode & 0x00F0u) >> 4u;
+
+    unsigned int count = 0;
+    switch (opcode & 0xF000u) {
+        case 0x0000u:
+            if ((opcode & 0x00FFu) == 0xE0u) return ((uint64_t(1) << VIDEO_PAGES) - 1) << MEMORY_PAGES;
+            return 0;
+        case 0xD000u: {
+            uint64_t pages = 0;
+            for (unsigned int row = 0; row < (opcode & 0x000Fu); ++row)
+            {
+                pages |= uint64_t(1) << (MEMORY_PAGES + ((m.registers[y] + row) & (VIDEO_HEIGHT - 1)));
+            }
+            return pages;
+        }
+        case 0xF000u:
+            if ((opcode & 0x00FFu) == 0x33u) count = 3;
+            if ((opcode & 0x00FFu) == 0x55u) count = x + 1;
+            break;
+    }
+    if (count == 0) return 0;
+    unsigned int first = (m.index_reg & (MEMORY_SIZE - 1)) / SNAPSHOT_PAGE_SIZE;
+    unsigned int last = ((m.index_reg & (MEMORY_SIZE - 1)) + count - 1) / SNAPSHOT_PAGE_SIZE;
+    return (uint64_t(1) << (first & (MEMORY_PAGES - 1))) | (uint64_t(1) << (last & (MEMORY_PAGES - 1)));
+}
+
+// `current` is the snapshot the machine was last loaded from and `dirty` the pages written since,
+// every other page already holds the right data when the two snapshots share it
+static void Load(Machine& m, Snapshot const& s, Snapshot const* current, uint64_t dirty)
+{
+    for (unsigned int i = 0; i < PAGE_COUNT; ++i)
+    {
+        if (current && current->pages[i] == s.pages[i] && !(dirty & (uint64_t(1) << i))) continue;
+        memcpy(PageData(m, i), s.pages[i]->data, SNAPSHOT_PAGE_SIZE);
+    }
+    memcpy(m.registers, s.registers, sizeof(m.registers));
+    memcpy(m.stack, s.stack, sizeof(m.stack));
+    memset(m.keypad, 0, sizeof(m.keypad));
+    m.index_reg = s.index_reg;
+    m.pc = s.pc;
+    m.delayTimer = s.delayTimer;
+    m.soundTimer = s.soundTimer;
+    m.sp = s.sp;
+    m.randGen = s.randGen;
+}
+
+// Copy-on-write: pages not written since the parent was loaded are shared without comparing,
+// written pages are only allocated if their data actually changed
+static void Save(Machine& m, Snapshot const* parent, uint64_t dirty, Snapshot& s)
+{
+    for (unsigned int i = 0; i < PAGE_COUNT; ++i)
+    {
+        uint8_t const* data = PageData(m, i);
+        if (parent && (!(dirty & (uint64_t(1) << i)) || memcmp(parent->pages[i]->data, data, SNAPSHOT_PAGE_SIZE) == 0))
+        {
+            s.pages[i] = parent->pages[i];
+            continue;
+        }
+        auto page = std::make_shared<Page>();
+        memcpy(page->data, data, SNAPSHOT_PAGE_SIZE);
+        page->hash = HashBytes(page->data, SNAPSHOT_PAGE_SIZE, i);
+        s.pages[i] = page;
+    }
+    memcpy(s.registers, m.registers, sizeof(s.registers));
+    memcpy(s.stack, m.stack, sizeof(s.stack));
+    s.index_reg = m.index_reg;
+    s.pc = m.pc;
+    s.delayTimer = m.delayTimer;
+    s.soundTimer = m.soundTimer;
+    s.sp = m.sp;
+    s.randGen = m.randGen;
+}
+
+// The sound timer is left out: it only drives the beeper, never what the program does next
+static uint64_t Digest(Snapshot const& s, bool ignoreRandom)
+{
+    uint8_t cpu[REGISTER_COUNT + STACK_LEVELS * 2 + 7];
+    uint8_t* p = cpu;
+    memcpy(p, s.registers, REGISTER_COUNT);     p += REGISTER_COUNT;
+    memcpy(p, s.stack, STACK_LEVELS * 2);       p += STACK_LEVELS * 2;
+    memcpy(p, &s.index_reg, 2);                 p += 2;
+    memcpy(p, &s.pc, 2);                        p += 2;
+    *p++ = s.delayTimer;
+    *p++ = s.timerPhase;
+    *p++ = s.sp;
+
+    uint64_t digest = HashBytes(cpu, sizeof(cpu), PAGE_COUNT);
+    for (unsigned int i = 0; i < PAGE_COUNT; ++i) digest += s.pages[i]->hash;
+
+    if (!ignoreRandom)
+    {
+        // The engine state is not readable, but minstd's next output maps one to one to it
+        std::minstd_rand0 engine = s.randGen;
+        digest += Mix(engine() + PAGE_COUNT + 1);
+    }
+    return digest;
+}
+
+// -- Visited States --
+/*
+ * Maps each digest to the fewest keypad reads it was reached with. Branches run
+ * breadth-first, but with several workers a state can still be found later through
+ * a shorter input. Then it is explored again, which keeps the shortest target inputs exact.
+ */
+class DigestSet
+{
+public:
+    enum Result { New, Shorter, Visited };
+
+    Result Insert(uint64_t digest, unsigned int depth)
+    {
+        Shard& shard = shards[digest >> 58];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto [entry, inserted] = shard.depths.try_emplace(digest, depth);
+        if (inserted)
+        {
+            ++count;
+            return New;
+        }
+        if (depth >= entry->second) return Visited;
+        entry->second = depth;
+        return Shorter;
+    }
+
+    unsigned long long Size() const { return count.load(std::memory_order_relaxed); }
+
+private:
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, unsigned int> depths;
+    };
+    Shard shards[64];
+    std::atomic<unsigned long long> count{0};
+};
+
+// -- Explorer --
+static bool IsKeypadRead(uint16_t opcode)
+{
+    uint16_t masked = opcode & 0xF0FFu;
+    return masked == 0xE09Eu || masked == 0xE0A1u || masked == 0xF00Au;
+}
+
+static bool IsConditional(uint16_t opcode)
+{
+    switch (opcode & 0xF000u) {
+        case 0x3000u: case 0x4000u: case 0x5000u: case 0x9000u: return true;
+        case 0xE000u: return (opcode & 0x00FFu) == 0x9Eu || (opcode & 0x00FFu) == 0xA1u;
+        default: return false;
+    }
+}
+
+struct Shared {
+    ExploreOptions const& options;
+    bool isTarget[MEMORY_SIZE]{};
+    DigestSet visited;
+
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    std::deque<Task> queue;     // FIFO: branches run in order of input length
+    unsigned int busy = 0;
+    bool stop = false;
+
+    std::mutex targetMutex;
+    std::shared_ptr<const InputNode> targetInput[MEMORY_SIZE];
+    unsigned int targetDepth[MEMORY_SIZE];              // UINT_MAX until the target is reached
+    unsigned long long targetHits[MEMORY_SIZE]{};       // Unique states whose branch passed the target
+
+    explicit Shared(ExploreOptions const& options) : options(options)
+    {
+        std::fill(std::begin(targetDepth), std::end(targetDepth), UINT_MAX);
+    }
+};
+
+class Worker
+{
+public:
+    uint8_t pcSeen[MEMORY_SIZE]{};
+    uint8_t branchSeen[MEMORY_SIZE]{};  // Bit 0: fell through, bit 1: skipped
+    unsigned long long segments = 0, duplicates = 0, shortened = 0, abandoned = 0, stopped = 0;
+
+    explicit Worker(Shared& shared) : shared(shared), machine(std::make_unique<Machine>()) {}
+
+    void Loop()
+    {
+        std::vector<Task> children;
+        for (;;)
+        {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(shared.queueMutex);
+                shared.queueReady.wait(lock, [this] { return shared.stop || !shared.queue.empty() || shared.busy == 0; });
+                if (shared.stop || shared.queue.empty()) break;
+                task = std::move(shared.queue.front());
+                shared.queue.pop_front();
+                ++shared.busy;
+            }
+
+            children.clear();
+            Run(task, children);
+
+            {
+                std::lock_guard<std::mutex> lock(shared.queueMutex);
+                for (Task& child : children) shared.queue.push_back(std::move(child));
+                --shared.busy;
+                if (shared.visited.Size() >= shared.options.maxStates) shared.stop = true;
+            }
+            shared.queueReady.notify_all();
+        }
+        shared.queueReady.notify_all();
+    }
+
+private:
+    Shared& shared;
+    std::unique_ptr<Machine> machine;
+    uint8_t timerPhase = 0;
+    std::shared_ptr<const Snapshot> loaded;  // Snapshot the machine pages were last loaded from
+    uint64_t dirty = 0;                      // Pages written since then
+    unsigned long long targetSegment[MEMORY_SIZE]{};  // Last segment that hit each target, counts a loop once
+    std::vector<uint16_t> targetsHit;                   // Targets hit by the current segment
+
+    void Execute()
+    {
+        uint16_t pc = machine->pc & (MEMORY_SIZE - 1);
+        dirty |= WrittenPages(*machine);
+        Step(*machine);
+        pcSeen[pc] = 1;
+        if (IsConditional(machine->opcode)) branchSeen[pc] |= (machine->pc == uint16_t(pc + 4)) ? 2 : 1;
+
+        if (++timerPhase == CYCLES_PER_TIMER_TICK) {
+            timerPhase = 0;
+            if (machine->delayTimer > 0) --machine->delayTimer;
+            if (machine->soundTimer > 0) --machine->soundTimer;
+        }
+    }
+
+    void Run(Task const& task, std::vector<Task>& children)
+    {
+        ++segments;
+        Load(*machine, *task.state, loaded.get(), dirty);
+        loaded = task.state;
+        dirty = 0;
+        timerPhase = task.state->timerPhase;
+
+        // Replay the decision at the keypad read this branch starts on
+        if (task.input)
+        {
+            if (task.input->pressed) machine->keypad[task.input->key] = 1;
+            Execute();
+        }
+
+        // Targets passed on the way are only noted, the branch keeps running so they don't prune the search
+        targetsHit.clear();
+        uint16_t opcode;
+        for (unsigned int steps = 0; ; ++steps)
+        {
+            uint16_t pc = machine->pc & (MEMORY_SIZE - 1);
+            if (shared.isTarget[pc] && targetSegment[pc] != segments)
+            {
+                targetSegment[pc] = segments;
+                targetsHit.push_back(pc);
+            }
+            opcode = (machine->memory[pc] << 8u) | machine->memory[(pc + 1) & (MEMORY_SIZE - 1)];
+            if (IsKeypadRead(opcode)) break;
+            if (steps == shared.options.segmentSteps)
+            {
+                ++abandoned;
+                ReachTargets(task.input, true);
+                return;
+            }
+            Execute();
+        }
+
+        auto state = std::make_shared<Snapshot>();
+        Save(*machine, task.state.get(), dirty, *state);
+        loaded = state;
+        dirty = 0;
+        state->timerPhase = timerPhase;
+        unsigned int depth = task.input ? task.input->depth : 0;
+        DigestSet::Result result = shared.visited.Insert(Digest(*state, shared.options.ignoreRandom), depth);
+        // Hits are counted once per unique state, a duplicate can still carry a shorter input
+        ReachTargets(task.input, result == DigestSet::New);
+        if (result == DigestSet::Visited)
+        {
+            ++duplicates;
+            return;
+        }
+        if (result == DigestSet::Shorter) ++shortened;
+
+        // A target that waits for a key (like GAME OVER) would otherwise fork into every restart
+        uint16_t pc = state->pc & (MEMORY_SIZE - 1);
+        if (shared.isTarget[pc] && !shared.options.continuePastTarget)
+        {
+            ++stopped;
+            return;
+        }
+
+        auto branch = [&](uint8_t key, bool pressed) {
+            children.push_back({state, std::make_shared<InputNode>(InputNode{task.input, pc, key, pressed, depth + 1})});
+        };
+
+        if ((opcode & 0xF0FFu) == 0xF00Au)
+        {
+            for (uint8_t key = 0; key < KEY_COUNT; ++key) branch(key, true);
+        }
+        else
+        {
+            uint8_t key = state->registers[(opcode & 0x0F00u) >> 8u] & (KEY_COUNT - 1);
+            branch(key, false);
+            branch(key, true);
+        }
+    }
+
+    void ReachTargets(std::shared_ptr<const InputNode> const& input, bool count)
+    {
+        if (targetsHit.empty()) return;
+        std::lock_guard<std::mutex> lock(shared.targetMutex);
+        unsigned int depth = input ? input->depth : 0;
+        for (uint16_t pc : targetsHit)
+        {
+            if (count) ++shared.targetHits[pc];
+            if (depth < shared.targetDepth[pc])
+            {
+                shared.targetInput[pc] = input;
+                shared.targetDepth[pc] = depth;
+            }
+        }
+    }
+};
+
+static void PrintInputs(std::shared_ptr<const InputNode> input)
+{
+    std::vector<InputNode const*> path;
+    for (InputNode const* node = input.get(); node; node = node->parent.get()) path.push_back(node);
+
+    printf("  Inputs (%zu keypad reads, PC:KEY, + pressed / - released):", path.size());
+    for (size_t i = 0; i < path.size(); ++i)
+    {
+        InputNode const* node = path[path.size() - 1 - i];
+        if (i % 8 == 0) printf("\n   ");
+        printf(" %03X:%X%c", node->pc, node->key, node->pressed ? '+' : '-');
+    }
+    printf("\n");
+}
+
+void RunExplorer(uint8_t const* image, ExploreOptions const& options)
+{
+    auto shared = std::make_unique<Shared>(options);
+    for (uint16_t target : options.targets) shared->isTarget[target & (MEMORY_SIZE - 1)] = true;
+
+    // Root branch: fresh machine at START_ADDRESS
+    auto root = std::make_unique<Machine>();
+    memcpy(root->memory, image, MEMORY_SIZE);
+    root->pc = START_ADDRESS;
+    auto rootState = std::make_shared<Snapshot>();
+    Save(*root, nullptr, 0, *rootState);
+    shared->queue.push_back({rootState, nullptr});
+
+    unsigned int threadCount = options.threads ? options.threads : std::thread::hardware_concurrency();
+    if (threadCount == 0) threadCount = 1;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < threadCount; ++i) workers.push_back(std::make_unique<Worker>(*shared));
+    for (auto& worker : workers) threads.emplace_back(&Worker::Loop, worker.get());
+    for (auto& thread : threads) thread.join();
+
+    float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+
+    // -- Report --
+    uint8_t pcSeen[MEMORY_SIZE]{};
+    uint8_t branchSeen[MEMORY_SIZE]{};
+    unsigned long long segments = 0, duplicates = 0, shortened = 0, abandoned = 0, stopped = 0;
+    for (auto& worker : workers)
+    {
+        for (unsigned int i = 0; i < MEMORY_SIZE; ++i)
+        {
+            pcSeen[i] |= worker->pcSeen[i];
+            branchSeen[i] |= worker->branchSeen[i];
+        }
+        segments += worker->segments;
+        duplicates += worker->duplicates;
+        shortened += worker->shortened;
+        abandoned += worker->abandoned;
+        stopped += worker->stopped;
+    }
+
+    unsigned long long states = shared->visited.Size();
+    printf("Explored %llu branches on %u threads in %.1f s: %llu unique states (%.0f per minute), %llu duplicates, %llu revisited by a shorter input, %llu abandoned, %llu stopped at a target%s\n",
+           segments, threadCount, seconds, states, states / seconds * 60.0f, duplicates, shortened, abandoned, stopped,
+           shared->stop ? ", state limit reached" : "");
+    if (options.ignoreRandom) printf("States differing only in RNG state were treated as visited\n");
+
+    unsigned int pcCount = 0, conditionals = 0, bothWays = 0;
+    for (unsigned int i = 0; i < MEMORY_SIZE; ++i)
+    {
+        pcCount += pcSeen[i];
+        if (branchSeen[i]) ++conditionals;
+        if (branchSeen[i] == 3) ++bothWays;
+    }
+    printf("PC coverage: %u instructions executed\n", pcCount);
+    printf("Branch coverage: %u of %u conditional instructions went both ways\n", bothWays, conditionals);
+    for (unsigned int i = 0; i < MEMORY_SIZE; ++i)
+    {
+        if (branchSeen[i] == 1) printf("  0x%03X never skipped\n", i);
+        if (branchSeen[i] == 2) printf("  0x%03X always skipped\n", i);
+    }
+
+    for (uint16_t target : options.targets)
+    {
+        uint16_t pc = target & (MEMORY_SIZE - 1);
+        if (shared->targetDepth[pc] == UINT_MAX)
+        {
+            printf("Target 0x%03X not reached\n", pc);
+            continue;
+        }
+        // Only exact if the search ran to completion
+        printf("Target 0x%03X reached from %llu unique states, %s:\n", pc, shared->targetHits[pc],
+               shared->stop ? "shortest input found before the state limit" : "shortest input");
+        PrintInputs(shared->targetInput[pc]);
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "core.h"
+
+// -- State-Space Explorer --
+/*
+ * Automated playtesting: runs the Machine core and forks it at every keypad read
+ * (Ex9E, ExA1, Fx0A) into each possible input, on a pool of worker threads.
+ * Branches share unchanged memory/video pages copy-on-write and states already
+ * visited are dropped through a set of state digests.
+ * Reports PC and branch coverage plus the inputs that reach each target PC.
+ * A branch that stops at a keypad read on a target PC is not forked further by default.
+ */
+
+// CHIP-8 memory is only 4 KB, so pages are smaller: one video page is one screen row
+const unsigned int SNAPSHOT_PAGE_SIZE = 256;
+const unsigned int MEMORY_PAGES = MEMORY_SIZE / SNAPSHOT_PAGE_SIZE;
+const unsigned int VIDEO_PAGES = VIDEO_HEIGHT * VIDEO_WIDTH * sizeof(uint32_t) / SNAPSHOT_PAGE_SIZE;
+
+struct ExploreOptions {
+    std::vector<uint16_t> targets;
+    unsigned long long maxStates = 1000000;  // Stops after this many unique states
+    unsigned int segmentSteps = 100000;      // Abandons a branch that runs this long without reading the keypad
+    unsigned int threads = 0;                // 0 = one per hardware thread
+    bool ignoreRandom = false;               // States differing only in RNG state count as visited (approximation)
+    bool continuePastTarget = false;         // Keeps branching at a target that is itself a keypad read
+};
+
+// image is a full MEMORY_SIZE memory with the fontset and ROM loaded, execution starts at START_ADDRESS
+void RunExplorer(uint8_t const* image, ExploreOptions const& options);
@@ -0,0 +1,28 @@
+#include "hash.h"
+#include <cstring>
+
+uint64_t Mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t HashBytes(void const* data, size_t size, uint64_t seed)
+{
+    uint8_t const* bytes = static_cast<uint8_t const*>(data);
+    uint64_t h = Mix(seed + 0x9E3779B97F4A7C15ull);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        h = (h ^ word) * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 29;
+    }
+    for (; i < size; ++i) h = (h ^ bytes[i]) * 0x100000001B3ull;
+    return Mix(h);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// -- Hashing --
+/*
+ * Fast non-cryptographic 64-bit hash shared by the lockstep state hash and the
+ * explorer's state digests. Different seeds give independent hashes of the same bytes.
+ */
+uint64_t Mix(uint64_t h);
+uint64_t HashBytes(void const* data, size_t size, uint64_t seed);
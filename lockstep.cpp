@@ -0,0 +1,305 @@
+#include "lockstep.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+StateView ViewOf(Machine& m)
+{
+    return {m.keypad, m.video, m.memory, m.registers, &m.index_reg, &m.pc,
+            &m.delayTimer, &m.soundTimer, m.stack, &m.sp};
+}
+
+// -- Hashing --
+static uint64_t HashBlock(StateView const& s, unsigned int block)
+{
+    return HashBytes(s.memory + block * HASH_BLOCK_SIZE, HASH_BLOCK_SIZE, block);
+}
+
+static uint64_t HashRow(StateView const& s, unsigned int row)
+{
+    return HashBytes(s.video + row * VIDEO_WIDTH, VIDEO_WIDTH * sizeof(uint32_t), HASH_BLOCKS + row);
+}
+
+void StateHash::Reset(StateView const& s)
+{
+    memoryHash = 0;
+    for (unsigned int i = 0; i < HASH_BLOCKS; ++i)
+    {
+        blocks[i] = HashBlock(s, i);
+        memoryHash += blocks[i];
+    }
+    videoHash = 0;
+    for (unsigned int i = 0; i < VIDEO_HEIGHT; ++i)
+    {
+        rows[i] = HashRow(s, i);
+        videoHash += rows[i];
+    }
+}
+
+void StateHash::Update(StateView const& s, WriteSet const& writes)
+{
+    if (writes.memoryCount > 0)
+    {
+        unsigned int first = writes.memoryStart / HASH_BLOCK_SIZE;
+        unsigned int last = (writes.memoryStart + writes.memoryCount - 1) / HASH_BLOCK_SIZE;
+        for (unsigned int i = first; i <= last; ++i)
+        {
+            unsigned int block = i & (HASH_BLOCKS - 1);
+            memoryHash -= blocks[block];
+            blocks[block] = HashBlock(s, block);
+            memoryHash += blocks[block];
+        }
+    }
+    for (unsigned int i = 0; i < writes.rowCount; ++i)
+    {
+        unsigned int row = (writes.rowStart + i) & (VIDEO_HEIGHT - 1);
+        videoHash -= rows[row];
+        rows[row] = HashRow(s, row);
+        videoHash += rows[row];
+    }
+}
+
+uint64_t StateHash::Value(StateView const& s) const
+{
+    uint8_t cpu[REGISTER_COUNT + STACK_LEVELS * 2 + 7];
+    uint8_t* p = cpu;
+    memcpy(p, s.registers, REGISTER_COUNT);             p += REGISTER_COUNT;
+    memcpy(p, s.stack, STACK_LEVELS * 2);               p += STACK_LEVELS * 2;
+    memcpy(p, s.pc, 2);                                 p += 2;
+    memcpy(p, s.index_reg, 2);                          p += 2;
+    *p++ = *s.sp;
+    *p++ = *s.delayTimer;
+    *p++ = *s.soundTimer;
+
+    return HashBytes(cpu, sizeof(cpu), 0) ^ Mix(memoryHash) ^ Mix(videoHash + 1);
+}
+
+WriteSet PredictWrites(StateView const& s)
+{
+    WriteSet writes;
+    uint16_t pc = *s.pc & (MEMORY_SIZE - 1);
+    uint16_t opcode = (s.memory[pc] << 8u) | s.memory[(pc + 1) & (MEMORY_SIZE - 1)];
+    uint8_t x = (opcode & 0x0F00u) >> 8u;
+    uint8_t y = (opcode & 0x00F0u) >> 4u;
+
+    switch (opcode & 0xF000u) {
+        case 0x0000u:
+            if ((opcode & 0x00FFu) == 0xE0u) writes.rowCount = VIDEO_HEIGHT;
+            break;
+        case 0xD000u:
+            writes.rowStart = s.registers[y] & (VIDEO_HEIGHT - 1);
+            writes.rowCount = opcode & 0x000Fu;
+            break;
+        case 0xF000u:
+            writes.memoryStart = *s.index_reg & (MEMORY_SIZE - 1);
+            if ((opcode & 0x00FFu) == 0x33u) writes.memoryCount = 3;
+            if ((opcode & 0x00FFu) == 0x55u) writes.memoryCount = x + 1;
+            break;
+    }
+    return writes;
+}
+
+bool IsSafe(StateView const& s)
+{
+    if (*s.pc > MEMORY_SIZE - 2) return false;
+
+    uint16_t opcode = (s.memory[*s.pc] << 8u) | s.memory[*s.pc + 1];
+    uint8_t x = (opcode & 0x0F00u) >> 8u;
+    uint8_t kk = opcode & 0x00FFu;
+    unsigned int index = *s.index_reg;
+
+    switch (opcode & 0xF000u) {
+        case 0x0000u: return kk != 0xEEu || *s.sp > 0;
+        case 0x2000u: return *s.sp < STACK_LEVELS;
+        case 0xD000u: return index + (opcode & 0x000Fu) <= MEMORY_SIZE;
+        case 0xE000u: return (kk != 0x9Eu && kk != 0xA1u) || s.registers[x] < KEY_COUNT;
+        case 0xF000u:
+            if (kk == 0x33u) return index + 3 <= MEMORY_SIZE;
+            if (kk == 0x55u || kk == 0x65u) return index + x + 1 <= MEMORY_SIZE;
+            return true;
+        default: return true;
+    }
+}
+
+int PrintDiff(StateView const& ref, StateView const& cand)
+{
+    int differences = 0;
+    auto field = [&differences](char const* name, unsigned int a, unsigned int b) {
+        if (a == b) return;
+        printf("  %-10s ref=0x%X cand=0x%X\n", name, a, b);
+        ++differences;
+    };
+
+    char name[16];
+    for (unsigned int i = 0; i < REGISTER_COUNT; ++i)
+    {
+        snprintf(name, sizeof(name), "V%X", i);
+        field(name, ref.registers[i], cand.registers[i]);
+    }
+    field("pc", *ref.pc, *cand.pc);
+    field("index_reg", *ref.index_reg, *cand.index_reg);
+    field("sp", *ref.sp, *cand.sp);
+    field("delayTimer", *ref.delayTimer, *cand.delayTimer);
+    field("soundTimer", *ref.soundTimer, *cand.soundTimer);
+    for (unsigned int i = 0; i < STACK_LEVELS; ++i)
+    {
+        snprintf(name, sizeof(name), "stack[%u]", i);
+        field(name, ref.stack[i], cand.stack[i]);
+    }
+
+    int memoryDiffs = 0;
+    for (unsigned int i = 0; i < MEMORY_SIZE; ++i)
+    {
+        if (ref.memory[i] == cand.memory[i]) continue;
+        if (memoryDiffs++ < 16) printf("  memory[0x%03X] ref=0x%02X cand=0x%02X\n", i, ref.memory[i], cand.memory[i]);
+    }
+    if (memoryDiffs > 16) printf("  ... %d memory bytes differ\n", memoryDiffs);
+
+    int videoDiffs = 0;
+    for (unsigned int i = 0; i < VIDEO_WIDTH * VIDEO_HEIGHT; ++i)
+    {
+        if (ref.video[i] == cand.video[i]) continue;
+        if (videoDiffs++ < 16) printf("  video(%u, %u) ref=%u cand=%u\n", i % VIDEO_WIDTH, i / VIDEO_WIDTH, ref.video[i] != 0, cand.video[i] != 0);
+    }
+    if (videoDiffs > 16) printf("  ... %d pixels differ\n", videoDiffs);
+
+    return differences + memoryDiffs + videoDiffs;
+}
+
+// -- Random ROMs --
+static void ResetState(StateView const& s, uint8_t const* image, uint8_t const* keys)
+{
+    memcpy(s.memory, image, MEMORY_SIZE);
+    memcpy(s.keypad, keys, KEY_COUNT);
+    memset(s.video, 0, VIDEO_WIDTH * VIDEO_HEIGHT * sizeof(uint32_t));
+    memset(s.registers, 0, REGISTER_COUNT);
+    memset(s.stack, 0, STACK_LEVELS * sizeof(uint16_t));
+    *s.index_reg = 0;
+    *s.pc = START_ADDRESS;
+    *s.delayTimer = 0;
+    *s.soundTimer = 0;
+    *s.sp = 0;
+}
+
+static void StartRom(ReferenceCore const& ref, Machine& machine, uint8_t const* image, uint8_t const* keys,
+                     unsigned int romSeed, StateHash& refHash, StateHash& candHash)
+{
+    StateView cand = ViewOf(machine);
+    ResetState(ref.view, image, keys);
+    ResetState(cand, image, keys);
+    ref.seed(romSeed);
+    machine.randGen.seed(romSeed);
+    machine.randByte.reset();
+    refHash.Reset(ref.view);
+    candHash.Reset(cand);
+}
+
+struct RomResult {
+    unsigned int steps{};   // Instructions executed by each core
+    bool unsafe{};
+    bool mismatch{};
+    uint16_t lastPc{};
+    uint16_t lastOpcode{};
+};
+
+// Steps both cores up to `steps` instructions, comparing hashes every `block` instructions
+static RomResult RunRom(ReferenceCore const& ref, void (*candidate)(Machine&), Machine& machine,
+                        StateHash& refHash, StateHash& candHash, unsigned int steps, unsigned int block)
+{
+    StateView cand = ViewOf(machine);
+    RomResult result;
+    unsigned int sinceCompare = 0;
+    while (result.steps < steps)
+    {
+        if (!IsSafe(ref.view) || !IsSafe(cand))
+        {
+            result.unsafe = true;
+            break;
+        }
+
+        WriteSet refWrites = PredictWrites(ref.view);
+        WriteSet candWrites = PredictWrites(cand);
+        result.lastPc = *ref.view.pc;
+        result.lastOpcode = (ref.view.memory[result.lastPc] << 8u) | ref.view.memory[result.lastPc + 1];
+
+        ref.step();
+        candidate(machine);
+        refHash.Update(ref.view, refWrites);
+        candHash.Update(cand, candWrites);
+        ++result.steps;
+
+        if (++sinceCompare < block) continue;
+        sinceCompare = 0;
+
+        if (refHash.Value(ref.view) != candHash.Value(cand))
+        {
+            result.mismatch = true;
+            break;
+        }
+    }
+    return result;
+}
+
+bool RunLockstep(ReferenceCore const& ref, void (*candidate)(Machine&), LockstepOptions const& options)
+{
+    static Machine machine;
+    StateView cand = ViewOf(machine);
+    StateHash refHash, candHash;
+
+    std::mt19937 romGen(options.seed);
+    static uint8_t image[MEMORY_SIZE];
+    uint8_t keys[KEY_COUNT];
+
+    unsigned long long executed = 0, roms = 0, unsafe = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    while (executed < options.instructions)
+    {
+        // Same random program, keypad and RNG seed for both cores
+        memset(image, 0, START_ADDRESS);
+        for (unsigned int i = START_ADDRESS; i < MEMORY_SIZE; ++i) image[i] = romGen();
+        for (unsigned int i = 0; i < KEY_COUNT; ++i) keys[i] = (romGen() & 3) == 0;
+        unsigned int romSeed = romGen();
+
+        StartRom(ref, machine, image, keys, romSeed, refHash, candHash);
+        ++roms;
+
+        unsigned int steps = options.romSteps;
+        if (options.instructions - executed < steps) steps = options.instructions - executed;
+        RomResult result = RunRom(ref, candidate, machine, refHash, candHash, steps, options.block);
+
+        // Full comparison at the end also catches writes that PredictWrites() missed
+        bool mismatch = result.mismatch
+            || refHash.Value(ref.view) != candHash.Value(cand)
+            || memcmp(ref.view.memory, cand.memory, MEMORY_SIZE) != 0
+            || memcmp(ref.view.video, cand.video, VIDEO_WIDTH * VIDEO_HEIGHT * sizeof(uint32_t)) != 0;
+        if (mismatch)
+        {
+            // Hashes are only compared every `block` instructions: replay the ROM comparing after each one
+            if (options.block > 1 || !result.mismatch)
+            {
+                unsigned int replaySteps = result.steps;
+                StartRom(ref, machine, image, keys, romSeed, refHash, candHash);
+                result = RunRom(ref, candidate, machine, refHash, candHash, replaySteps, 1);
+            }
+            if (result.mismatch)
+            {
+                printf("Lockstep mismatch after instruction %llu (ROM %llu, step %u)\n", executed + result.steps, roms, result.steps - 1);
+                printf("Last instruction was pc 0x%03X opcode %04X\n", result.lastPc, result.lastOpcode);
+            }
+            else
+            {
+                printf("Lockstep mismatch at the end of ROM %llu (%llu instructions)\n", roms, executed + result.steps);
+            }
+            PrintDiff(ref.view, cand);
+            return false;
+        }
+        executed += result.steps;
+        if (result.unsafe) ++unsafe;
+    }
+
+    float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+    printf("Lockstep OK: %llu instructions on %llu random ROMs (%llu stopped out of bounds), %.0f instructions/s\n",
+           executed, roms, unsafe, executed / seconds);
+    return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include "core.h"
+#include "hash.h"
+
+// -- Lockstep --
+/*
+ * Runs the reference Cycle() and a candidate core side by side on random ROMs
+ * and stops with a full state diff on the first mismatch.
+ * Both cores are seen through a StateView, so the globals in main.cpp and a
+ * Machine are hashed and compared the same way.
+ */
+
+struct StateView {
+    uint8_t* keypad;
+    uint32_t* video;
+    uint8_t* memory;
+    uint8_t* registers;
+    uint16_t* index_reg;
+    uint16_t* pc;
+    uint8_t* delayTimer;
+    uint8_t* soundTimer;
+    uint16_t* stack;
+    uint8_t* sp;
+};
+
+StateView ViewOf(Machine& m);
+
+// -- State Hash --
+/*
+ * Memory is hashed in 64-byte blocks and video in rows. Before each instruction
+ * PredictWrites() tells which blocks/rows it can touch, only those are rehashed
+ * afterwards. CPU registers are small enough to hash every time.
+ */
+const unsigned int HASH_BLOCK_SIZE = 64;
+const unsigned int HASH_BLOCKS = MEMORY_SIZE / HASH_BLOCK_SIZE;
+
+struct WriteSet {
+    uint16_t memoryStart{};
+    uint16_t memoryCount{};
+    uint8_t rowStart{};
+    uint8_t rowCount{};
+};
+
+struct StateHash {
+    uint64_t blocks[HASH_BLOCKS]{};
+    uint64_t rows[VIDEO_HEIGHT]{};
+    uint64_t memoryHash{};
+    uint64_t videoHash{};
+
+    void Reset(StateView const& s);
+    void Update(StateView const& s, WriteSet const& writes);
+    uint64_t Value(StateView const& s) const;
+};
+
+WriteSet PredictWrites(StateView const& s);
+
+// False when the next instruction would make Cycle() read or write out of bounds
+bool IsSafe(StateView const& s);
+
+// Prints every field that differs between the two states, returns the number of differences
+int PrintDiff(StateView const& ref, StateView const& cand);
+
+// -- Runner --
+struct ReferenceCore {
+    StateView view;
+    void (*step)();
+    void (*seed)(unsigned int seed);
+};
+
+struct LockstepOptions {
+    unsigned long long instructions = 0;        // Total instructions per core, 0 = lockstep disabled
+    unsigned int seed = 1;
+    unsigned int block = 1;                     // Instructions between hash comparisons, a mismatch is replayed with 1
+    unsigned int romSteps = 20000;              // Instructions before switching to a new random ROM
+};
+
+// Returns true when both cores matched for the whole run
+bool RunLockstep(ReferenceCore const& ref, void (*candidate)(Machine&), LockstepOptions const& options);
@@ -1,20 +1,15 @@
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <random>
 
 #define SDL_MAIN_HANDLED
+#include "core.h"
+#include "explorer.h"
+#include "lockstep.h"
 #include "platform.h"
-
-// -- Constants --
-const unsigned int FONTSET_SIZE = 80;
-const unsigned int FONTSET_START_ADDRESS = 0x50;
-const unsigned int START_ADDRESS = 0x200;
-const unsigned int KEY_COUNT = 16;
-const unsigned int MEMORY_SIZE = 4096;
-const unsigned int REGISTER_COUNT = 16;
-const unsigned int STACK_LEVELS = 16;
-const unsigned int VIDEO_HEIGHT = 32;
-const unsigned int VIDEO_WIDTH = 64;
+#include "trace.h"
 
 // -- Global System Variables --
 uint8_t keypad[KEY_COUNT]{};
@@ -30,7 +25,7 @@ uint16_t stack[STACK_LEVELS]{};
 uint8_t sp{};
 uint16_t opcode{};
 
-std::default_random_engine randGen;
+std::minstd_rand0 randGen;
 std::uniform_int_distribution<uint8_t> randByte;
 
 // -- CPU Operations --
@@ -368,6 +363,12 @@ void InitCHIP8() {
     randByte = std::uniform_int_distribution<uint8_t>(0, 255);
 }
 
+// Restarts the random generator from a fixed seed, used to replay runs in lockstep
+void SeedCHIP8(unsigned int seed) {
+    randGen.seed(seed);
+    randByte.reset();
+}
+
 void LoadROM() {
     for (uint16_t i = 0; i < sizeof(ROM); ++i) memory[START_ADDRESS + i] = ROM[i];
 }
@@ -493,6 +494,7 @@ void TableF(uint8_t x, uint8_t kk) {
 
 // -- Cycle --
 void Cycle() {
+    TRACE_BEGIN();
     opcode = (memory[pc] << 8u) | memory[pc + 1];
     pc += 2;
 
@@ -521,14 +523,105 @@ void Cycle() {
 		case 0xF000u: TableF(x, kk); break;
 		default: OP_NULL(); break;
 	}
+    TRACE_END();
 }
 
-int main() {
-	Platform platform("CHIP-8 Emulator", VIDEO_WIDTH * 10, VIDEO_HEIGHT * 10, VIDEO_WIDTH, VIDEO_HEIGHT);
+// -- Headless --
+/*
+ * Runs the ROM without window, audio or input as fast as possible.
+ * Timers tick every CYCLES_PER_TIMER_TICK cycles.
+ */
+void RunHeadless(unsigned long long cycles) {
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (unsigned long long i = 0; i < cycles; ++i) {
+		Cycle();
+		if (i % CYCLES_PER_TIMER_TICK == CYCLES_PER_TIMER_TICK - 1) {
+			if (delayTimer > 0) --delayTimer;
+			if (soundTimer > 0) --soundTimer;
+		}
+	}
+
+	float ms = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+	printf("Executed %llu cycles in %.1f ms (%.0f IPS)\n", cycles, ms, cycles / (ms / 1000.0f));
+}
+
+int main(int argc, char* argv[]) {
+	/* OPTIONS:
+	 * --headless N  Runs N cycles without the SDL platform
+	 * --trace FILE  Writes an execution trace (requires CHIP8_TRACE)
+	 * --lockstep N  Checks the Machine core against Cycle() on N instructions of random ROMs
+	 * --seed S      Random ROM seed for --lockstep
+	 * --block B     Instructions between lockstep comparisons
+	 * --explore N   Explores up to N unique states of the ROM, branching on every keypad read
+	 * --target PC   Hex PC the explorer should find inputs for (repeatable, default 360 = GAME OVER)
+	 * --ignore-random  Explorer treats states that differ only in RNG state as the same
+	 * --continue-past-target  Explorer keeps branching at a target that waits for a key
+	 */
+	unsigned long long headlessCycles = 0;
+	char const* tracePath = nullptr;
+	LockstepOptions lockstep;
+	ExploreOptions explore;
+	explore.maxStates = 0;
+
+	for (int i = 1; i < argc; ++i) {
+		char const* option = argv[i];
+		if (strcmp(option, "--ignore-random") == 0) {
+			explore.ignoreRandom = true;
+			continue;
+		}
+		if (strcmp(option, "--continue-past-target") == 0) {
+			explore.continuePastTarget = true;
+			continue;
+		}
+		if (i + 1 >= argc) break;
+		char const* value = argv[++i];
+
+		if (strcmp(option, "--headless") == 0) headlessCycles = strtoull(value, nullptr, 10);
+		else if (strcmp(option, "--trace") == 0) tracePath = value;
+		else if (strcmp(option, "--lockstep") == 0) lockstep.instructions = strtoull(value, nullptr, 10);
+		else if (strcmp(option, "--seed") == 0) lockstep.seed = strtoul(value, nullptr, 10);
+		else if (strcmp(option, "--block") == 0) lockstep.block = strtoul(value, nullptr, 10);
+		else if (strcmp(option, "--explore") == 0) explore.maxStates = strtoull(value, nullptr, 10);
+		else if (strcmp(option, "--target") == 0) explore.targets.push_back(strtoul(value, nullptr, 16));
+	}
+
+	if (lockstep.instructions > 0) {
+		ReferenceCore reference{
+			{keypad, video, memory, registers, &index_reg, &pc, &delayTimer, &soundTimer, stack, &sp},
+			Cycle,
+			SeedCHIP8
+		};
+		return RunLockstep(reference, Step, lockstep) ? 0 : 1;
+	}
 
 	InitCHIP8();
 	LoadROM();
 
+	if (explore.maxStates > 0) {
+		if (explore.targets.empty()) explore.targets.push_back(0x360);
+		RunExplorer(memory, explore);
+		return 0;
+	}
+
+	if (tracePath) {
+#ifdef CHIP8_TRACE
+		if (!TraceOpen(tracePath)) fprintf(stderr, "Cannot open trace file %s\n", tracePath);
+#else
+		fprintf(stderr, "Tracing not available, build with CHIP8_TRACE\n");
+#endif
+	}
+
+	if (headlessCycles > 0) {
+		RunHeadless(headlessCycles);
+#ifdef CHIP8_TRACE
+		TraceClose();
+#endif
+		return 0;
+	}
+
+	Platform platform("CHIP-8 Emulator", VIDEO_WIDTH * 10, VIDEO_HEIGHT * 10, VIDEO_WIDTH, VIDEO_HEIGHT);
+
 	int videoPitch = sizeof(video[0]) * VIDEO_WIDTH;
 	auto lastCycleTime = std::chrono::high_resolution_clock::now();
 	auto lastTimerTime = std::chrono::high_resolution_clock::now();
@@ -560,5 +653,8 @@ int main() {
 			}
 		}
 	}
+#ifdef CHIP8_TRACE
+	TraceClose();
+#endif
 	return 0;
 }
@@ -0,0 +1,150 @@
+#include "trace.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+
+bool traceEnabled = false;
+TraceEntry traceRing[TRACE_RING_SIZE];
+std::atomic<uint32_t> traceHead{0};
+std::atomic<uint32_t> traceTail{0};
+uint32_t traceCycle = 0;
+
+static FILE* traceFile = nullptr;
+static std::thread traceWriter;
+static std::atomic<bool> traceStop{false};
+static std::mutex traceMutex;
+static std::condition_variable traceWake;
+
+// -- Encoder State --
+static uint32_t prevCycle = 0xFFFFFFFFu;
+static uint16_t prevPc = 0x200 - 2;
+static uint16_t prevIndex = 0;
+static uint16_t lastOpcode[0x1000]{};
+
+static uint8_t* PutWord(uint8_t* out, uint16_t word)
+{
+    *out++ = word >> 8u;
+    *out++ = word & 0xFFu;
+    return out;
+}
+
+// Worst case encoded size of one entry
+const unsigned int TRACE_MAX_ENCODED = 48;
+
+static uint8_t* Encode(uint8_t* out, TraceEntry const& entry)
+{
+    uint32_t delta = entry.cycle - prevCycle;
+    uint16_t pc = entry.pc & 0xFFFu;
+
+    uint8_t flags = 0;
+    if (delta != 1)                          flags |= TRACE_CYCLE;
+    if (entry.pc != uint16_t(prevPc + 2))    flags |= TRACE_PC;
+    if (entry.opcode != lastOpcode[pc])      flags |= TRACE_OP;
+    if (entry.index != prevIndex)            flags |= TRACE_INDEX;
+    if (entry.changed != 0)                  flags |= TRACE_REG;
+
+    *out++ = flags;
+    if (flags & TRACE_CYCLE)
+    {
+        while (delta >= 0x80u)
+        {
+            *out++ = (delta & 0x7Fu) | 0x80u;
+            delta >>= 7;
+        }
+        *out++ = delta;
+    }
+    if (flags & TRACE_PC)    out = PutWord(out, entry.pc);
+    if (flags & TRACE_OP)    out = PutWord(out, entry.opcode);
+    if (flags & TRACE_INDEX) out = PutWord(out, entry.index);
+    if (flags & TRACE_REG)
+    {
+        uint8_t* last = out;
+        for (uint8_t i = 0; i < 16; ++i)
+        {
+            if (!(entry.changed & (1u << i))) continue;
+            last = out;
+            *out++ = i;
+            *out++ = entry.registers[i];
+        }
+        *last |= TRACE_LAST_REG;
+    }
+
+    prevCycle = entry.cycle;
+    prevPc = entry.pc;
+    prevIndex = entry.index;
+    lastOpcode[pc] = entry.opcode;
+    return out;
+}
+
+// Drains the ring to disk one chunk at a time, so the producer gets space back early
+static void Drain()
+{
+    static uint8_t buffer[TRACE_CHUNK * TRACE_MAX_ENCODED];
+
+    uint32_t tail = traceTail.load(std::memory_order_relaxed);
+    uint32_t head = traceHead.load(std::memory_order_acquire);
+    while (tail != head)
+    {
+        uint32_t end = (head - tail > TRACE_CHUNK) ? tail + TRACE_CHUNK : head;
+        uint8_t* out = buffer;
+        for (; tail != end; ++tail)
+        {
+            out = Encode(out, traceRing[tail & (TRACE_RING_SIZE - 1)]);
+        }
+        traceTail.store(tail, std::memory_order_release);
+        fwrite(buffer, 1, out - buffer, traceFile);
+        head = traceHead.load(std::memory_order_acquire);
+    }
+}
+
+void TraceWakeWriter()
+{
+    std::lock_guard<std::mutex> lock(traceMutex);
+    traceWake.notify_one();
+}
+
+// Woken by the producer every TRACE_CHUNK entries, the timeout only flushes slow (windowed) runs
+static void WriterLoop()
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(traceMutex);
+            traceWake.wait_for(lock, std::chrono::milliseconds(100), [] {
+                return traceStop.load(std::memory_order_acquire)
+                    || traceHead.load(std::memory_order_acquire) - traceTail.load(std::memory_order_relaxed) >= TRACE_CHUNK;
+            });
+        }
+        bool stop = traceStop.load(std::memory_order_acquire);
+        Drain();
+        if (stop) break;
+    }
+}
+
+bool TraceOpen(char const* path)
+{
+    traceFile = fopen(path, "wb");
+    if (!traceFile) return false;
+
+    fwrite(TRACE_MAGIC, 1, sizeof(TRACE_MAGIC), traceFile);
+    fputc(TRACE_VERSION, traceFile);
+
+    traceStop = false;
+    traceWriter = std::thread(WriterLoop);
+    traceEnabled = true;
+    return true;
+}
+
+void TraceClose()
+{
+    if (!traceFile) return;
+
+    traceEnabled = false;
+    traceStop.store(true, std::memory_order_release);
+    TraceWakeWriter();
+    traceWriter.join();
+
+    fclose(traceFile);
+    traceFile = nullptr;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+// -- Execution Trace --
+/*
+ * Optional trace of every executed instruction, enabled by building with CHIP8_TRACE.
+ * Cycle() pushes one fixed-size TraceEntry per instruction into an in-memory ring,
+ * a background thread drains the ring and writes it to disk as a compressed stream.
+ * Without CHIP8_TRACE the TRACE_* macros expand to nothing.
+ */
+
+const uint32_t TRACE_RING_SIZE = 1u << 19;  // Must be a power of two, about 8 ms of turbo execution
+const uint32_t TRACE_CHUNK = 1u << 12;      // The writer is woken and the ring released in chunks of this size
+
+struct TraceEntry {
+    uint32_t cycle;
+    uint16_t pc;
+    uint16_t opcode;
+    uint16_t index;         // index_reg after the instruction
+    uint16_t changed;       // Bit i set if Vi was changed by the instruction
+    uint8_t registers[16];  // V0-VF after the instruction
+    uint8_t unused[4];
+};
+
+// -- File Format --
+/*
+ * Header: "C8TR" + version byte.
+ * Each entry starts with a flag byte telling which fields follow, everything else
+ * is predicted from the previous entry:
+ *   TRACE_CYCLE  cycle delta != 1   -> varint delta
+ *   TRACE_PC     pc != previous+2   -> 2 bytes
+ *   TRACE_OP     opcode differs from the last one seen at this pc -> 2 bytes
+ *   TRACE_INDEX  index_reg changed  -> 2 bytes
+ *   TRACE_REG    registers changed  -> register byte + value byte per changed register,
+ *                                      TRACE_LAST_REG set in the register byte of the last one
+ * Multi-byte fields are big-endian like CHIP-8 opcodes.
+ */
+const char TRACE_MAGIC[4] = {'C', '8', 'T', 'R'};
+const uint8_t TRACE_VERSION = 2;
+
+const uint8_t TRACE_CYCLE = 0x01;
+const uint8_t TRACE_PC = 0x02;
+const uint8_t TRACE_OP = 0x04;
+const uint8_t TRACE_INDEX = 0x08;
+const uint8_t TRACE_REG = 0x10;
+const uint8_t TRACE_LAST_REG = 0x80;
+
+// -- Recorder --
+bool TraceOpen(char const* path);
+void TraceClose();
+void TraceWakeWriter();
+
+extern bool traceEnabled;
+extern TraceEntry traceRing[TRACE_RING_SIZE];
+extern std::atomic<uint32_t> traceHead;
+extern std::atomic<uint32_t> traceTail;
+extern uint32_t traceCycle;
+
+inline void TracePush(uint16_t pc, uint16_t opcode, uint8_t const* before, uint8_t const* after, uint16_t index)
+{
+    TraceEntry entry{};
+    entry.cycle = traceCycle++;
+    entry.pc = pc;
+    entry.opcode = opcode;
+    entry.index = index;
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+        entry.changed |= uint16_t(before[i] != after[i]) << i;
+    }
+    memcpy(entry.registers, after, sizeof(entry.registers));
+
+    uint32_t head = traceHead.load(std::memory_order_relaxed);
+    // Ring full: wait for the writer instead of losing entries
+    while (head - traceTail.load(std::memory_order_acquire) == TRACE_RING_SIZE)
+    {
+        std::this_thread::yield();
+    }
+    traceRing[head & (TRACE_RING_SIZE - 1)] = entry;
+    traceHead.store(head + 1, std::memory_order_release);
+    if (((head + 1) & (TRACE_CHUNK - 1)) == 0) TraceWakeWriter();
+}
+
+#ifdef CHIP8_TRACE
+#define TRACE_BEGIN() \
+    uint16_t tracePc = pc; \
+    uint8_t traceRegs[16]; \
+    if (traceEnabled) memcpy(traceRegs, registers, sizeof(traceRegs))
+#define TRACE_END() \
+    if (traceEnabled) TracePush(tracePc, opcode, traceRegs, registers, index_reg)
+#else
+#define TRACE_BEGIN()
+#define TRACE_END()
+#endif
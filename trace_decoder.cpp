@@ -0,0 +1,223 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "trace.h"
+
+// -- Trace Decoder --
+/*
+ * Reads a trace written by the emulator (built with CHIP8_TRACE) and prints
+ * one disassembled line per instruction.
+ * USAGE: Chip8TraceDecoder <file> [--pc LO[-HI]] [--op PATTERN] [--from CYCLE] [--to CYCLE]
+ *   --op takes 4 hex digits, x/y/n/k are wildcards (e.g. Ex9E, Fx0A, Dxyn)
+ */
+
+std::string Disassemble(uint16_t opcode)
+{
+    char text[32];
+    unsigned x = (opcode & 0x0F00u) >> 8u;
+    unsigned y = (opcode & 0x00F0u) >> 4u;
+    unsigned n =  opcode & 0x000Fu;
+    unsigned kk = opcode & 0x00FFu;
+    unsigned nnn = opcode & 0x0FFFu;
+
+    switch (opcode & 0xF000u) {
+        // Decoded on kk like Table0, so 0nE0/0nEE show as the CLS/RET they execute as
+        case 0x0000u:
+            if (kk == 0xE0u)      snprintf(text, sizeof(text), "CLS");
+            else if (kk == 0xEEu) snprintf(text, sizeof(text), "RET");
+            else                  snprintf(text, sizeof(text), "SYS 0x%03X", nnn);
+            break;
+        case 0x1000u: snprintf(text, sizeof(text), "JP 0x%03X", nnn); break;
+        case 0x2000u: snprintf(text, sizeof(text), "CALL 0x%03X", nnn); break;
+        case 0x3000u: snprintf(text, sizeof(text), "SE V%X, 0x%02X", x, kk); break;
+        case 0x4000u: snprintf(text, sizeof(text), "SNE V%X, 0x%02X", x, kk); break;
+        case 0x5000u: snprintf(text, sizeof(text), "SE V%X, V%X", x, y); break;
+        case 0x6000u: snprintf(text, sizeof(text), "LD V%X, 0x%02X", x, kk); break;
+        case 0x7000u: snprintf(text, sizeof(text), "ADD V%X, 0x%02X", x, kk); break;
+        // Only the 8xyN forms Table8 implements, the rest execute as no-ops
+        case 0x8000u: {
+            static char const* const names[16] = {
+                "LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", nullptr,
+                nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, "SHL", nullptr
+            };
+            if (names[n]) snprintf(text, sizeof(text), "%s V%X, V%X", names[n], x, y);
+            else          snprintf(text, sizeof(text), "DW 0x%04X", opcode);
+            break;
+        }
+        case 0x9000u: snprintf(text, sizeof(text), "SNE V%X, V%X", x, y); break;
+        case 0xA000u: snprintf(text, sizeof(text), "LD I, 0x%03X", nnn); break;
+        case 0xB000u: snprintf(text, sizeof(text), "JP V0, 0x%03X", nnn); break;
+        case 0xC000u: snprintf(text, sizeof(text), "RND V%X, 0x%02X", x, kk); break;
+        case 0xD000u: snprintf(text, sizeof(text), "DRW V%X, V%X, %u", x, y, n); break;
+        case 0xE000u:
+            if (kk == 0x9Eu)      snprintf(text, sizeof(text), "SKP V%X", x);
+            else if (kk == 0xA1u) snprintf(text, sizeof(text), "SKNP V%X", x);
+            else                  snprintf(text, sizeof(text), "DW 0x%04X", opcode);
+            break;
+        case 0xF000u:
+            switch (kk) {
+                case 0x07u: snprintf(text, sizeof(text), "LD V%X, DT", x); break;
+                case 0x0Au: snprintf(text, sizeof(text), "LD V%X, K", x); break;
+                case 0x15u: snprintf(text, sizeof(text), "LD DT, V%X", x); break;
+                case 0x18u: snprintf(text, sizeof(text), "LD ST, V%X", x); break;
+                case 0x1Eu: snprintf(text, sizeof(text), "ADD I, V%X", x); break;
+                case 0x29u: snprintf(text, sizeof(text), "LD F, V%X", x); break;
+                case 0x33u: snprintf(text, sizeof(text), "LD B, V%X", x); break;
+                case 0x55u: snprintf(text, sizeof(text), "LD [I], V%X", x); break;
+                case 0x65u: snprintf(text, sizeof(text), "LD V%X, [I]", x); break;
+                default:    snprintf(text, sizeof(text), "DW 0x%04X", opcode); break;
+            }
+            break;
+    }
+    return text;
+}
+
+// Turns a pattern like "Fx0A" into a mask/value pair
+bool ParsePattern(char const* pattern, uint16_t* mask, uint16_t* value)
+{
+    if (strlen(pattern) != 4) return false;
+    *mask = 0;
+    *value = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        char c = pattern[i];
+        unsigned shift = (3 - i) * 4;
+        if (c == 'x' || c == 'y' || c == 'n' || c == 'k') continue;
+        char digit[2] = {c, 0};
+        char* end;
+        unsigned long nibble = strtoul(digit, &end, 16);
+        if (*end != 0) return false;
+        *mask |= 0xFu << shift;
+        *value |= nibble << shift;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "USAGE: %s <file> [--pc LO[-HI]] [--op PATTERN] [--from CYCLE] [--to CYCLE]\n", argv[0]);
+        return 1;
+    }
+
+    // -- Filters --
+    uint16_t pcLow = 0x000, pcHigh = 0xFFF;
+    uint16_t opMask = 0, opValue = 0;
+    uint64_t fromCycle = 0, toCycle = UINT64_MAX;
+
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--pc") == 0)
+        {
+            char* end;
+            pcLow = pcHigh = strtoul(argv[i + 1], &end, 16);
+            if (*end == '-') pcHigh = strtoul(end + 1, nullptr, 16);
+        }
+        else if (strcmp(argv[i], "--op") == 0)
+        {
+            if (!ParsePattern(argv[i + 1], &opMask, &opValue))
+            {
+                fprintf(stderr, "Invalid opcode pattern: %s\n", argv[i + 1]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--from") == 0) fromCycle = strtoull(argv[i + 1], nullptr, 10);
+        else if (strcmp(argv[i], "--to") == 0)   toCycle = strtoull(argv[i + 1], nullptr, 10);
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    FILE* file = fopen(argv[1], "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    char magic[sizeof(TRACE_MAGIC)];
+    if (fread(magic, 1, sizeof(magic), file) != sizeof(magic)
+        || memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0
+        || fgetc(file) != TRACE_VERSION)
+    {
+        fprintf(stderr, "%s is not a CHIP-8 trace\n", argv[1]);
+        fclose(file);
+        return 1;
+    }
+
+    // -- Decoder State (mirrors the encoder in trace.cpp) --
+    uint64_t cycle = UINT64_MAX;
+    uint16_t pc = 0x200 - 2;
+    uint16_t index = 0;
+    uint8_t registers[16]{};
+    static uint16_t lastOpcode[0x1000]{};
+
+    auto getWord = [file]() {
+        int high = fgetc(file);
+        int low = fgetc(file);
+        return uint16_t((high << 8u) | low);
+    };
+
+    int flags;
+    while ((flags = fgetc(file)) != EOF)
+    {
+        uint64_t delta = 1;
+        if (flags & TRACE_CYCLE)
+        {
+            delta = 0;
+            int byte, shift = 0;
+            do {
+                byte = fgetc(file);
+                if (byte == EOF) break;
+                delta |= uint64_t(byte & 0x7F) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+        }
+        cycle += delta;
+        pc = (flags & TRACE_PC) ? getWord() : uint16_t(pc + 2);
+        if (flags & TRACE_OP) lastOpcode[pc & 0xFFFu] = getWord();
+        uint16_t opcode = lastOpcode[pc & 0xFFFu];
+        if (flags & TRACE_INDEX) index = getWord();
+
+        uint16_t changed = 0;
+        if (flags & TRACE_REG)
+        {
+            int reg;
+            do {
+                reg = fgetc(file);
+                int value = fgetc(file);
+                if (value == EOF) break;
+                changed |= 1u << (reg & 0xFu);
+                registers[reg & 0xFu] = value;
+            } while (!(reg & TRACE_LAST_REG));
+        }
+
+        if (feof(file))
+        {
+            fprintf(stderr, "Truncated trace at cycle %llu\n", (unsigned long long)cycle);
+            break;
+        }
+
+        if (cycle > toCycle) break;
+        if (cycle < fromCycle) continue;
+        if (pc < pcLow || pc > pcHigh) continue;
+        if ((opcode & opMask) != opValue) continue;
+
+        printf("%10llu  0x%03X  %04X  %-16s I=0x%03X VF=%u",
+               (unsigned long long)cycle, pc, opcode, Disassemble(opcode).c_str(), index, registers[0xF]);
+        for (unsigned int i = 0; i < 16; ++i)
+        {
+            if (changed & (1u << i)) printf(" V%X=0x%02X", i, registers[i]);
+        }
+        printf("\n");
+    }
+
+    fclose(file);
+    return 0;
+}